@@ -0,0 +1,86 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <cstdlib>
+#include <ctime>
+
+#include "../src/gpss.h"
+
+using namespace smpl;
+using namespace std;
+
+// Модель из usage.cpp, записанная блоками. Интервалы A±B включают обе границы:
+// поступления через [14; 26] и обслуживание [12; 20] тактов вместо [14; 26) и [12; 20) в usage.cpp.
+// Текст модели можно также читать из файла: ifstream src("model.gps");
+const char * Model =
+        "* Одноканальная система с очередью\n"
+        "        GENERATE  20,6\n"
+        "        QUEUE     Accumulator\n"
+        "        SEIZE     Master\n"
+        "        ADVANCE   16,4\n"
+        "        RELEASE   Master\n"
+        "        TERMINATE\n"
+        "* Таймер: окончание моделирования через 480 тактов\n"
+        "        GENERATE  480\n"
+        "        TERMINATE 1\n";
+
+// Три транзакта одновременно приходят к устройству: двое ждут в очереди,
+// поступив в один и тот же такт, и оба должны быть обслужены
+const char * Simultaneous =
+        "        GENERATE  100,0,,1\n"
+        "        TRANSFER  ,Serve\n"
+        "        GENERATE  100,0,,1\n"
+        "        TRANSFER  ,Serve\n"
+        "        GENERATE  100,0,,1\n"
+        "Serve   QUEUE     Q\n"
+        "        SEIZE     D\n"
+        "        ADVANCE   5\n"
+        "        RELEASE   D\n"
+        "        TERMINATE\n";
+
+// Проверка: моделируем до исчерпания событий и считаем обслуженные транзакты
+bool checkSimultaneous() {
+    ostringstream out;
+    Engine e(&out);
+    BlockProgram program(&e);
+    istringstream src(Simultaneous);
+    program.compile(src);
+    program.run(1);
+
+    size_t served = e.getDevice(0)->transactCount;
+    if (served != 3 || e.getQueue(0)->length() != 0) {
+        cerr << "Simultaneous arrivals: served " << served << " of 3" << endl;
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    srand(time(NULL));
+
+    if (!checkSimultaneous())
+        return 1;
+
+    ofstream fout("report.txt");
+    Engine * e = new Engine(&fout);
+    BlockProgram program(e);
+
+    try {
+        istringstream src(Model);
+        program.compile(src);
+        // Моделируем до срабатывания таймера, как START 1
+        program.run(1);
+    } catch (runtime_error &err) {
+        cerr << "Model error: " << err.what() << endl;
+        delete e;
+        return 1;
+    }
+
+    e->monitor();
+    e->report();
+
+    delete e;
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <sstream>
+
+#include <cstdlib>
+#include <ctime>
+
+#include "../src/gpss.h"
+#include "../src/splitting.h"
+
+using namespace smpl;
+using namespace std;
+
+// Одноканальная система с загрузкой около 0.9, моделируем 4800 тактов
+const char * Model =
+        "        GENERATE  20,10\n"
+        "        QUEUE     Accumulator\n"
+        "        SEIZE     Master\n"
+        "        ADVANCE   18,6\n"
+        "        RELEASE   Master\n"
+        "        TERMINATE\n"
+        "        GENERATE  4800\n"
+        "        TERMINATE 1\n";
+
+// Траектория, у которой редкое событие - превышение длиной очереди порога
+class Overflow : public Trajectory {
+private:
+    BlockProgram program;
+    Queue * queue;
+
+public:
+    Overflow(Engine *e) : Trajectory(e), program(e), queue(NULL) {
+        istringstream src(Model);
+        program.compile(src);
+        program.start(1);
+        queue = e->getQueue(0);
+    }
+    Overflow(const Overflow &other, Engine *e)
+            : Trajectory(e), program(other.program, e), queue(e->getQueue(0)) {}
+
+    Trajectory * clone(Engine *e) const {
+        return new Overflow(*this, e);
+    }
+    bool step() {
+        return program.step();
+    }
+    double importance() {
+        return queue->maxLength;
+    }
+};
+
+int main() {
+    srand(time(NULL));
+
+    Overflow prototype(new Engine(&cout));
+
+    // Вероятность того, что в очереди окажется 12 заявок (около 1e-6).
+    // Каждая траектория, впервые удлинившая очередь, расщепляется на 3 копии
+    Splitting splitting(rand());
+    for (int level = 1; level <= 12; ++level) {
+        splitting.addLevel(level, 3);
+    }
+    SplittingResult r = splitting.estimate(prototype, 1000);
+
+    cout << "P(Max >= 12) = " << r.probability
+         << ", отн. ошибка " << r.relativeError
+         << ", событий " << r.events
+         << ", траекторий " << r.trajectories << endl;
+    return 0;
+}
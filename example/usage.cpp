@@ -30,9 +30,9 @@ void model() {
     Device * dev = e->createDevice("Master");
     Queue * queue = e->createQueue("Accumulator");
 
-    transact_t transactCounter = 1;
-
-    e->schedule(EventGenerate, e->iRandom(14, 26), transactCounter);
+    // Источник заявок: интервалы между поступлениями равномерно распределены на [14; 26).
+    // Поступления не попадают в список событий, cause() возвращает их с новым номером транзакта
+    e->createSource(EventGenerate, ArrivalSource::Uniform, 14, 26);
     e->schedule(EventEnd, 480, 1e9);
 
     // Объявим переменную, в которой будем хранить номер текущего транзакта
@@ -49,12 +49,9 @@ void model() {
         switch (event) {
             // Алгоритм обработки события порождения заявки
             case EventGenerate: {
-                // Планируем сразу же событие резервирования устройства за этой заявкой
+                // Планируем сразу же событие резервирования устройства за этой заявкой.
+                // Поступление следующей заявки источник уже разыграл
                 e->schedule(EventReserve, 0, transact);
-                // Увеличиваем счетчик транзактов
-                transactCounter++;
-                // Планируем поступление следующией заявки
-                e->schedule(EventGenerate, e->iRandom(14, 26), transactCounter);
                 break;
             }
             // Алгоритм обработки события резервирования устройства
@@ -0,0 +1,597 @@
+#ifndef SMPL_GPSS_H
+#define SMPL_GPSS_H
+
+#include <istream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <stdexcept>
+#include <limits>
+
+#include <cctype>
+
+#include "smpl.h"
+
+/**
+ * Прямой шитый код (computed goto) доступен только в GCC-совместимых компиляторах,
+ * в остальных случаях используется диспетчеризация через switch
+ */
+#if defined(__GNUC__) && !defined(SMPL_NO_THREADED_DISPATCH)
+#define SMPL_THREADED_DISPATCH
+#endif
+
+namespace smpl
+{
+    /**
+     * Блок программы модели
+     */
+    class Block {
+    public:
+        enum Op {
+            OpGenerate = 0,
+            OpSeize,
+            OpAdvance,
+            OpRelease,
+            OpTerminate,
+            OpTransfer
+        };
+
+        /** Тип блока */
+        Op op;
+        /** Адрес обработчика блока в интерпретаторе (прямой шитый код) */
+        const void *handler;
+        /** A, среднее значение интервала (GENERATE, ADVANCE) */
+        time_t mean;
+        /** B, полуширина интервала (GENERATE, ADVANCE) */
+        time_t spread;
+        /** C, время появления первого транзакта (GENERATE) */
+        time_t offset;
+        bool hasOffset;
+        /** D для GENERATE - предельное число транзактов, A для TERMINATE - уменьшение счетчика завершений */
+        u64 count;
+        /** Вероятность перехода на target (TRANSFER) */
+        double fraction;
+        /** Номер блока, в который переходит транзакт при срабатывании TRANSFER */
+        size_t target;
+        /** Номер следующего блока */
+        size_t next;
+        /** Устройство (SEIZE, RELEASE) */
+        Device *device;
+        /** Очередь для статистики ожидания устройства (SEIZE) */
+        Queue *queue;
+        /** Номер списка ожидания устройства (SEIZE, RELEASE) */
+        size_t wait;
+        /** Номер строки исходного текста */
+        int line;
+
+        Block(Op op, int line)
+                : op(op), handler(NULL), mean(0), spread(0), offset(0), hasOffset(false),
+                count(0), fraction(1.0), target(0), next(0),
+                device(NULL), queue(NULL), wait(0), line(line) {}
+    };
+
+    /**
+     * Транзакт, ожидающий освобождения устройства
+     */
+    class Waiting {
+    public:
+        /** J, транзакт */
+        transact_t transactId;
+        /** T, время начала ожидания */
+        time_t time;
+        /** Номер блока SEIZE, в котором ждет транзакт */
+        size_t seize;
+
+        Waiting(transact_t transactId, time_t time, size_t seize)
+                : transactId(transactId), time(time), seize(seize) {}
+    };
+
+    /**
+     * Программа модели, записанная в виде последовательности блоков в стиле GPSS:
+     *
+     *     * комментарий
+     *     метка  БЛОК  операнд,операнд,...  ; комментарий
+     *
+     * Поддерживаемые блоки:
+     *     GENERATE A,B,C,D   порождение транзактов через A±B тактов, первый в момент C, не более D штук
+     *     QUEUE    имя       учет ожидания в следующем блоке SEIZE в статистике очереди
+     *     SEIZE    имя       занятие устройства или ожидание его освобождения
+     *     ADVANCE  A,B       задержка на A±B тактов
+     *     RELEASE  имя       освобождение устройства и передача его первому ожидающему транзакту
+     *     TERMINATE A        уничтожение транзакта, счетчик завершений уменьшается на A
+     *     TRANSFER ,B        безусловный переход на метку B
+     *     TRANSFER P,A,B     переход на B с вероятностью P, иначе на A (или на следующий блок)
+     *
+     * Программа компилируется в плоский массив блоков, переходы TRANSFER без условия
+     * разрешаются на этапе компиляции. Событие в списке событий Engine означает вход
+     * транзакта J в блок с номером E. Блоки GENERATE становятся источниками заявок
+     * Engine с номером события, равным номеру блока. У каждого устройства есть свой
+     * список ожидания в порядке поступления, общий для всех блоков SEIZE этого устройства.
+     */
+    class BlockProgram {
+    private:
+        Engine *engine;
+        std::vector<Block> blocks;
+        std::map<std::string, Device *> devices;
+        std::map<std::string, Queue *> queues;
+        /** Списки ожидания устройств */
+        std::vector< std::deque<Waiting> > waits;
+        /** Счетчик завершений */
+        u64 terminations;
+        bool linked;
+
+        time_t delay(const Block &b);
+        void execute(size_t pc, transact_t transactId);
+        size_t resolve(size_t pc, int line);
+        void link(const std::map<std::string, size_t> &labels,
+                  const std::vector<std::string> &targetNames,
+                  const std::vector<std::string> &nextNames);
+        Device *device(const std::string &name);
+        Queue *queue(const std::string &name);
+
+    public:
+        BlockProgram(Engine *engine)
+                : engine(engine), terminations(0), linked(false) {
+            assert(engine != NULL);
+        }
+        /**
+         * Копия программы вместе с состоянием блоков, работающая с копией Engine
+         * @param other Исходная программа
+         * @param engine Результат other.engine->clone()
+         */
+        BlockProgram(const BlockProgram &other, Engine *engine);
+        /**
+         * Трансляция текста модели в программу
+         * Устройства и очереди создаются в Engine при первом упоминании
+         * @param in Поток с текстом модели
+         * @throws std::runtime_error при синтаксической ошибке
+         */
+        void compile(std::istream &in);
+        /**
+         * Создает источники заявок для блоков GENERATE
+         * @param count Начальное значение счетчика завершений
+         */
+        void start(u64 count);
+        /**
+         * Аналог START: start() и моделирование до обнуления счетчика завершений
+         * или исчерпания списка событий
+         * @param count Начальное значение счетчика завершений
+         */
+        void run(u64 count);
+        /**
+         * Обработка очередного события
+         * @return false, если моделирование завершено
+         */
+        bool step();
+        size_t size();
+    };
+
+    namespace gpss
+    {
+        inline std::string upper(std::string s) {
+            for (size_t i = 0; i < s.size(); ++i) {
+                s[i] = (char) toupper((unsigned char) s[i]);
+            }
+            return s;
+        }
+
+        inline std::string error(int line, const std::string &message) {
+            std::stringstream ss;
+            ss << "line " << line << ": " << message;
+            return ss.str();
+        }
+
+        template<typename T>
+        T number(const std::string &s, int line) {
+            std::istringstream in(s);
+            T x;
+            // Поток читает "-1" в беззнаковый тип как 2^64-1
+            bool negative = !s.empty() && s[0] == '-';
+            if ((negative && !std::numeric_limits<T>::is_signed) || !(in >> x) || !in.eof()) {
+                throw std::runtime_error(error(line, "invalid number '" + s + "'"));
+            }
+            return x;
+        }
+
+        /**
+         * Наибольшее число операндов блока
+         */
+        inline size_t operands(const std::string &s) {
+            if (s == "GENERATE") return 4;
+            if (s == "ADVANCE") return 2;
+            if (s == "TRANSFER") return 3;
+            return 1;
+        }
+
+        inline bool isBlock(const std::string &s) {
+            return s == "GENERATE" || s == "QUEUE" || s == "SEIZE" || s == "ADVANCE"
+                   || s == "RELEASE" || s == "TERMINATE" || s == "TRANSFER";
+        }
+    }
+
+    BlockProgram::BlockProgram(const BlockProgram &other, Engine *engine)
+            : engine(engine), blocks(other.blocks), waits(other.waits),
+            terminations(other.terminations), linked(other.linked) {
+        assert(engine != NULL);
+        assert(engine->devicesCount() == other.engine->devicesCount());
+        assert(engine->queuesCount() == other.engine->queuesCount());
+
+        // Устройства и очереди копии Engine имеют те же номера
+        std::map<Device *, Device *> deviceMap;
+        for (size_t i = 0; i < engine->devicesCount(); ++i) {
+            deviceMap[other.engine->getDevice(i)] = engine->getDevice(i);
+        }
+        std::map<Queue *, Queue *> queueMap;
+        for (size_t i = 0; i < engine->queuesCount(); ++i) {
+            queueMap[other.engine->getQueue(i)] = engine->getQueue(i);
+        }
+        deviceMap[NULL] = NULL;
+        queueMap[NULL] = NULL;
+
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            blocks[i].device = deviceMap[blocks[i].device];
+            blocks[i].queue = queueMap[blocks[i].queue];
+        }
+        for (std::map<std::string, Device *>::const_iterator it = other.devices.begin(); it != other.devices.end(); ++it) {
+            devices[it->first] = deviceMap[it->second];
+        }
+        for (std::map<std::string, Queue *>::const_iterator it = other.queues.begin(); it != other.queues.end(); ++it) {
+            queues[it->first] = queueMap[it->second];
+        }
+    }
+
+    Device *BlockProgram::device(const std::string &name) {
+        std::map<std::string, Device *>::iterator it = devices.find(name);
+        if (it != devices.end())
+            return it->second;
+        Device *d = engine->createDevice(name);
+        devices[name] = d;
+        return d;
+    }
+
+    Queue *BlockProgram::queue(const std::string &name) {
+        std::map<std::string, Queue *>::iterator it = queues.find(name);
+        if (it != queues.end())
+            return it->second;
+        Queue *q = engine->createQueue(name);
+        queues[name] = q;
+        return q;
+    }
+
+    void BlockProgram::compile(std::istream &in) {
+        assert(blocks.empty());
+
+        std::map<std::string, size_t> labels;
+        // Имена меток для TRANSFER: target - переход по условию, next - иначе
+        std::vector<std::string> targetNames;
+        std::vector<std::string> nextNames;
+        // Очередь из предшествующего блока QUEUE для статистики следующего SEIZE
+        Queue *pendingQueue = NULL;
+
+        std::string text;
+        int line = 0;
+        while (std::getline(in, text)) {
+            line++;
+            size_t comment = text.find(';');
+            if (comment != std::string::npos)
+                text.erase(comment);
+
+            std::istringstream ls(text);
+            std::vector<std::string> words;
+            std::string w;
+            while (ls >> w) words.push_back(w);
+            if (words.empty() || words[0][0] == '*')
+                continue;
+
+            std::string label;
+            if (!gpss::isBlock(gpss::upper(words[0]))) {
+                label = words[0];
+                words.erase(words.begin());
+                if (words.empty())
+                    throw std::runtime_error(gpss::error(line, "block expected after label '" + label + "'"));
+            }
+            if (words.size() > 2)
+                throw std::runtime_error(gpss::error(line, "unexpected '" + words[2] + "'"));
+
+            std::string name = gpss::upper(words[0]);
+            if (!gpss::isBlock(name))
+                throw std::runtime_error(gpss::error(line, "unknown block '" + words[0] + "'"));
+
+            std::vector<std::string> ops;
+            if (words.size() > 1) {
+                std::string s = words[1];
+                size_t start = 0, pos;
+                while ((pos = s.find(',', start)) != std::string::npos) {
+                    ops.push_back(s.substr(start, pos - start));
+                    start = pos + 1;
+                }
+                ops.push_back(s.substr(start));
+            }
+            if (ops.size() > gpss::operands(name))
+                throw std::runtime_error(gpss::error(line, "too many operands for " + name));
+            ops.resize(4);
+
+            if (!label.empty()) {
+                if (labels.count(label))
+                    throw std::runtime_error(gpss::error(line, "duplicate label '" + label + "'"));
+                if (pendingQueue != NULL)
+                    throw std::runtime_error(gpss::error(line, "label between QUEUE and SEIZE"));
+                labels[label] = blocks.size();
+            }
+
+            if (pendingQueue != NULL && name != "SEIZE")
+                throw std::runtime_error(gpss::error(line, "SEIZE expected after QUEUE"));
+
+            if (name == "QUEUE") {
+                if (ops[0].empty())
+                    throw std::runtime_error(gpss::error(line, "queue name expected"));
+                // QUEUE сливается со следующим SEIZE в один блок
+                pendingQueue = queue(ops[0]);
+                continue;
+            }
+
+            Block b(Block::OpGenerate, line);
+            if (name == "GENERATE" || name == "ADVANCE") {
+                b.op = name == "GENERATE" ? Block::OpGenerate : Block::OpAdvance;
+                if (!ops[0].empty()) b.mean = gpss::number<time_t>(ops[0], line);
+                if (!ops[1].empty()) b.spread = gpss::number<time_t>(ops[1], line);
+                if (b.mean < 0 || b.spread < 0 || b.spread > b.mean)
+                    throw std::runtime_error(gpss::error(line, "invalid interval"));
+                if (b.op == Block::OpGenerate) {
+                    if (b.mean == 0)
+                        throw std::runtime_error(gpss::error(line, "GENERATE interval must be positive"));
+                    if (!ops[2].empty()) {
+                        b.offset = gpss::number<time_t>(ops[2], line);
+                        b.hasOffset = true;
+                        if (b.offset < 0)
+                            throw std::runtime_error(gpss::error(line, "invalid offset"));
+                    }
+                    if (!ops[3].empty()) b.count = gpss::number<u64>(ops[3], line);
+                }
+            } else if (name == "SEIZE") {
+                if (ops[0].empty())
+                    throw std::runtime_error(gpss::error(line, "device name expected"));
+                b.op = Block::OpSeize;
+                b.device = device(ops[0]);
+                b.queue = pendingQueue;
+                pendingQueue = NULL;
+            } else if (name == "RELEASE") {
+                if (ops[0].empty())
+                    throw std::runtime_error(gpss::error(line, "device name expected"));
+                b.op = Block::OpRelease;
+                b.device = device(ops[0]);
+            } else if (name == "TERMINATE") {
+                b.op = Block::OpTerminate;
+                if (!ops[0].empty()) b.count = gpss::number<u64>(ops[0], line);
+            } else if (name == "TRANSFER") {
+                b.op = Block::OpTransfer;
+                if (ops[0].empty()) {
+                    if (ops[1].empty() || !ops[2].empty())
+                        throw std::runtime_error(gpss::error(line, "TRANSFER ,B expected"));
+                } else {
+                    b.fraction = gpss::number<double>(ops[0], line);
+                    if (b.fraction < 0 || b.fraction > 1)
+                        throw std::runtime_error(gpss::error(line, "TRANSFER probability must be in [0; 1]"));
+                    if (ops[2].empty())
+                        throw std::runtime_error(gpss::error(line, "TRANSFER P,A,B expected"));
+                }
+            }
+
+            targetNames.resize(blocks.size() + 1);
+            nextNames.resize(blocks.size() + 1);
+            if (b.op == Block::OpTransfer) {
+                if (ops[0].empty()) {
+                    targetNames.back() = ops[1];
+                    b.fraction = 1.0;
+                } else {
+                    targetNames.back() = ops[2];
+                    nextNames.back() = ops[1];
+                }
+            }
+            blocks.push_back(b);
+        }
+
+        if (pendingQueue != NULL)
+            throw std::runtime_error(gpss::error(line, "SEIZE expected after QUEUE"));
+
+        link(labels, targetNames, nextNames);
+    }
+
+    /**
+     * Следование по цепочке безусловных TRANSFER до первого исполняемого блока
+     */
+    size_t BlockProgram::resolve(size_t pc, int line) {
+        for (size_t hops = 0; hops <= blocks.size(); ++hops) {
+            if (pc >= blocks.size())
+                throw std::runtime_error(gpss::error(line, "transaction leaves the end of the program"));
+            const Block &b = blocks[pc];
+            if (b.op != Block::OpTransfer || b.fraction < 1.0)
+                return pc;
+            pc = b.target;
+        }
+        throw std::runtime_error(gpss::error(line, "TRANSFER loop"));
+    }
+
+    void BlockProgram::link(const std::map<std::string, size_t> &labels,
+                            const std::vector<std::string> &targetNames,
+                            const std::vector<std::string> &nextNames) {
+        // Переходы по меткам
+        for (size_t pc = 0; pc < blocks.size(); ++pc) {
+            Block &b = blocks[pc];
+            b.next = pc + 1;
+            if (b.op != Block::OpTransfer)
+                continue;
+
+            std::map<std::string, size_t>::const_iterator it = labels.find(targetNames[pc]);
+            if (it == labels.end())
+                throw std::runtime_error(gpss::error(b.line, "unknown label '" + targetNames[pc] + "'"));
+            b.target = it->second;
+
+            if (!nextNames[pc].empty()) {
+                it = labels.find(nextNames[pc]);
+                if (it == labels.end())
+                    throw std::runtime_error(gpss::error(b.line, "unknown label '" + nextNames[pc] + "'"));
+                b.next = it->second;
+            }
+            if (b.fraction >= 1.0)
+                b.next = b.target;
+        }
+
+        // Списки ожидания устройств, общие для SEIZE и RELEASE одного устройства
+        std::map<Device *, size_t> waiting;
+        for (std::map<std::string, Device *>::iterator it = devices.begin(); it != devices.end(); ++it) {
+            size_t i = waiting.size();
+            waiting[it->second] = i;
+        }
+        waits.assign(waiting.size(), std::deque<Waiting>());
+
+        for (size_t pc = 0; pc < blocks.size(); ++pc) {
+            Block &b = blocks[pc];
+            if (b.device != NULL)
+                b.wait = waiting[b.device];
+
+            if (b.op == Block::OpTerminate || (b.op == Block::OpTransfer && b.fraction >= 1.0))
+                continue;
+            b.next = resolve(b.next, b.line);
+            if (b.op == Block::OpTransfer)
+                b.target = resolve(b.target, b.line);
+            if (blocks[b.next].op == Block::OpGenerate
+                || (b.op == Block::OpTransfer && blocks[b.target].op == Block::OpGenerate))
+                throw std::runtime_error(gpss::error(b.line, "transaction cannot enter GENERATE"));
+        }
+    }
+
+    time_t BlockProgram::delay(const Block &b) {
+        if (b.spread == 0)
+            return b.mean;
+        return engine->iRandom((uint) (b.mean - b.spread), (uint) (b.mean + b.spread + 1));
+    }
+
+    void BlockProgram::start(u64 count) {
+        terminations = count;
+        for (size_t pc = 0; pc < blocks.size(); ++pc) {
+            const Block &b = blocks[pc];
+            if (b.op != Block::OpGenerate)
+                continue;
+            ArrivalSource *s = b.spread == 0
+                    ? engine->createSource(pc, ArrivalSource::Constant, (uint) b.mean)
+                    : engine->createSource(pc, ArrivalSource::Uniform, (uint) (b.mean - b.spread),
+                                           (uint) (b.mean + b.spread + 1));
+            s->limit = b.count;
+            if (b.hasOffset)
+                s->nextTime = engine->getTime() + b.offset;
+        }
+    }
+
+    void BlockProgram::run(u64 count) {
+        start(count);
+        while (step());
+    }
+
+    bool BlockProgram::step() {
+        if (terminations == 0 || !engine->hasEvents())
+            return false;
+        std::pair<u64, transact_t> top = engine->cause();
+        execute((size_t) top.first, top.second);
+        return terminations > 0;
+    }
+
+    size_t BlockProgram::size() {
+        return blocks.size();
+    }
+
+    /**
+     * Продвижение транзакта по блокам до первой задержки
+     * @param pc Номер блока, в который входит транзакт
+     * @param transactId Транзакт
+     */
+    void BlockProgram::execute(size_t pc, transact_t transactId) {
+        assert(pc < blocks.size());
+#ifdef SMPL_THREADED_DISPATCH
+        static const void *handlers[] = {
+                &&generate, &&seize, &&advance, &&release, &&terminate, &&transfer
+        };
+        if (!linked) {
+            for (size_t i = 0; i < blocks.size(); ++i) {
+                blocks[i].handler = handlers[blocks[i].op];
+            }
+            linked = true;
+        }
+#define SMPL_DISPATCH() goto *b->handler
+#else
+#define SMPL_DISPATCH() goto dispatch
+#endif
+        Block *b = &blocks[pc];
+        time_t t;
+        SMPL_DISPATCH();
+
+#ifndef SMPL_THREADED_DISPATCH
+    dispatch:
+        switch (b->op) {
+            case Block::OpGenerate: goto generate;
+            case Block::OpSeize: goto seize;
+            case Block::OpAdvance: goto advance;
+            case Block::OpRelease: goto release;
+            case Block::OpTerminate: goto terminate;
+            case Block::OpTransfer: goto transfer;
+        }
+#endif
+
+    generate:
+        // Транзакт порожден источником заявок, следующий уже разыгран
+        b = &blocks[b->next];
+        SMPL_DISPATCH();
+
+    seize:
+        if (b->device->status() != 0) {
+            // Устройство занято, транзакт ждет и продолжит со следующего блока
+            waits[b->wait].push_back(Waiting(transactId, engine->getTime(), b - &blocks[0]));
+            if (b->queue != NULL)
+                b->queue->enqueue(transactId, 0, b->next);
+            return;
+        }
+        b->device->reserve(transactId);
+        b = &blocks[b->next];
+        SMPL_DISPATCH();
+
+    advance:
+        t = delay(*b);
+        if (t > 0) {
+            engine->schedule(b->next, t, transactId);
+            return;
+        }
+        b = &blocks[b->next];
+        SMPL_DISPATCH();
+
+    release:
+        if (b->device->status() != transactId) {
+            throw std::runtime_error(gpss::error(b->line, "device '" + b->device->name + "' is not seized by the transaction"));
+        }
+        b->device->release();
+        if (!waits[b->wait].empty()) {
+            // Передаем устройство первому ожидающему транзакту
+            Waiting w = waits[b->wait].front();
+            waits[b->wait].pop_front();
+            const Block &seize = blocks[w.seize];
+            if (seize.queue != NULL)
+                seize.queue->remove(QueueItem(w.time, w.transactId, 0, seize.next));
+            b->device->reserve(w.transactId);
+            engine->schedule(seize.next, 0, w.transactId);
+        }
+        b = &blocks[b->next];
+        SMPL_DISPATCH();
+
+    terminate:
+        terminations = terminations > b->count ? terminations - b->count : 0;
+        return;
+
+    transfer:
+        b = &blocks[b->fraction >= 1.0 || engine->fRandom() < b->fraction ? b->target : b->next];
+        SMPL_DISPATCH();
+#undef SMPL_DISPATCH
+    }
+}
+
+#endif //SMPL_GPSS_H
@@ -6,6 +6,7 @@
 #include <vector>
 #include <set>
 #include <list>
+#include <algorithm>
 
 #include <ctime>
 #include <cstdlib>
@@ -23,6 +24,86 @@ namespace smpl
     class Device;
     class Queue;
 
+    /**
+     * Генератор псевдослучайных чисел (SplitMix64)
+     * Состояние хранится в одном числе, поэтому генератор копируется вместе с Engine
+     */
+    class Random {
+    private:
+        u64 state;
+    public:
+        Random(u64 seed) : state(seed) {}
+        void seed(u64 seed) {
+            state = seed;
+        }
+        u64 next() {
+            u64 z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+        /**
+         * Случайное число с плавающей точкой в полуинтервале [0; 1)
+         */
+        double uniform() {
+            return (next() >> 11) * (1.0 / 9007199254740992.0);
+        }
+    };
+
+    /**
+     * Источник заявок: поток поступлений с заданным распределением интервалов.
+     * Очередное поступление не помещается в список событий, Engine::cause() сравнивает
+     * его с вершиной списка, поэтому на поступление не тратится вставка в список.
+     * Интервалы разыгрываются собственным генератором источника по одному.
+     */
+    class ArrivalSource {
+    public:
+        enum Distribution {
+            /** Постоянный интервал A */
+            Constant,
+            /** Равномерное распределение на [A; B), как Engine::iRandom */
+            Uniform,
+            /** Экспоненциальное распределение со средним A, как Engine::poisson */
+            Exponential
+        };
+
+    private:
+        Random rng;
+
+    public:
+        /** E, номер события (класс транзакта), которым cause() сообщает о поступлении */
+        u64 eventId;
+        Distribution distribution;
+        uint a;
+        uint b;
+        /** T, время следующего поступления */
+        time_t nextTime;
+        /** Предельное число поступлений, 0 - без ограничения */
+        u64 limit;
+        /** Count, счетчик поступлений */
+        u64 count;
+
+        ArrivalSource(u64 eventId, Distribution distribution, uint a, uint b, u64 seed)
+                : rng(seed), eventId(eventId), distribution(distribution),
+                a(a), b(b), nextTime(0), limit(0), count(0) {
+            assert(distribution != Uniform || a < b);
+            assert(distribution == Uniform || a > 0);
+        }
+        /**
+         * Переинициализация генератора
+         * @param seed
+         */
+        void seed(u64 seed);
+        /**
+         * Очередной интервал между поступлениями
+         */
+        time_t interval();
+        /**
+         * Есть ли еще поступления
+         */
+        bool active();
+    };
+
     class Engine {
     private:
         /**
@@ -31,21 +112,39 @@ namespace smpl
         std::ostream *outs;
         std::vector<Queue *> queues;
         std::vector<Device *> devices;
+        std::vector<ArrivalSource *> sources;
         std::set<Event> events;
+        Random rng;
+        /** Счетчик транзактов, порождаемых источниками */
+        transact_t transactCounter;
 
         time_t _time;
 
+        Engine(const Engine &);
+        Engine &operator=(const Engine &);
+        /**
+         * Пустой Engine для clone(): без setlocale() и без обращения к rand(),
+         * чтобы не сдвигать последовательность, заданную srand()
+         */
+        Engine(std::ostream *outputStream, const Random &rng)
+                : outs(outputStream), rng(rng), transactCounter(1), _time(0) {}
+
         void justify(std::string &s, size_t sz);
         void justifyVec(std::vector<std::string> &vec, const std::vector<size_t> &widths);
         void fillVec(char c, std::vector<std::string> &vec, const std::vector<size_t> &widths);
         std::string surround(char c, const std::vector<std::string> &v);
         size_t getLen(std::string &s);
         std::string printTable(std::vector< std::vector<std::string> > table);
+        static bool earlier(const std::pair<Event, bool> &a, const std::pair<Event, bool> &b);
         template<typename T>
         std::string toString(T x);
 
     public:
-        Engine(std::ostream *outputStream) : _time(0) {
+        /**
+         * Генератор инициализируется из rand(), поэтому srand() до создания Engine
+         * по-прежнему задает последовательность случайных чисел
+         */
+        Engine(std::ostream *outputStream) : rng(rand()), transactCounter(1), _time(0) {
             setlocale(LC_ALL, "ru_RU.UTF-8");
             outs = outputStream;
         }
@@ -53,6 +152,18 @@ namespace smpl
             reset();
         }
         void reset();
+        /**
+         * Копирование состояния моделирования: списка событий, очередей, устройств,
+         * модельного времени и генератора случайных чисел.
+         * Устройства и очереди копии имеют те же номера, что и в исходном Engine
+         * @return Новый Engine, который нужно удалить вызывающей стороне
+         */
+        Engine * clone() const;
+        /**
+         * Переинициализация генератора случайных чисел
+         * @param seed
+         */
+        void seed(u64 seed);
         /**
          * Определение устройства
          * @param name Название устройства
@@ -65,6 +176,31 @@ namespace smpl
          * @return Созданная очередь
          */
         Queue * createQueue(std::string name);
+        /**
+         * Определение источника заявок
+         * Первое поступление происходит через разыгранный интервал от текущего времени,
+         * его можно перенести, изменив nextTime
+         * @param eventId AE, номер события поступления
+         * @param distribution Распределение интервалов между поступлениями
+         * @param a Постоянный интервал, левая граница или среднее
+         * @param b Правая граница для равномерного распределения
+         * @return Созданный источник
+         */
+        ArrivalSource * createSource(u64 eventId, ArrivalSource::Distribution distribution, uint a, uint b = 0);
+        /**
+         * Номер нового транзакта. Источники заявок берут номера из этого же счетчика
+         */
+        transact_t newTransact();
+        /**
+         * Устройство по номеру в порядке создания
+         */
+        Device * getDevice(size_t i);
+        size_t devicesCount();
+        /**
+         * Очередь по номеру в порядке создания
+         */
+        Queue * getQueue(size_t i);
+        size_t queuesCount();
         /**
          * Планирование события
          * Помещение в список нового события
@@ -75,18 +211,25 @@ namespace smpl
         void schedule(u64 eventId, time_t time, transact_t transactId);
         /**
          * Обработка очередного события
+         * Если раньше всех наступает поступление от источника заявок, то возвращается
+         * его номер события и новый транзакт
          * @param eventId AE, ID события совершенного события
          * @param transactId AJ, ID транзакта
          */
         std::pair<u64, transact_t> cause();
         /**
-         * Удаление события из списка
+         * Удаление события из списка. Поступления от источников заявок не удаляются
          * @param eventId AE
          * @param transactId AJ
          * @return Разность между текущим модельным временем и временем наступления удаленного события
          */
         time_t cancel(u64 eventId, transact_t transactId);
         time_t getTime();
+        /**
+         * Проверка наличия запланированных событий
+         * @return true, если список событий не пуст
+         */
+        bool hasEvents();
         /**
          * Отражает на стандартном устройстве вывода или в файле состояние списка событий.
          * По каждому элементу списка выводится время свершения события, номер события и номер заявки.
@@ -116,7 +259,7 @@ namespace smpl
          */
         uint iRandom(uint L, uint R);
         /**
-         * Генерирует случайное число с плавающей точкой в отрезке [0; 1]
+         * Генерирует случайное число с плавающей точкой в полуинтервале [0; 1)
          * @return
          */
         double fRandom();
@@ -137,7 +280,11 @@ namespace smpl
         transact_t transactId;
 
         friend bool operator<(const Event &a, const Event &b) {
-            return a.time < b.time || (a.time == b.time && a.eventId < b.eventId);
+            if (a.time != b.time)
+                return a.time < b.time;
+            if (a.eventId != b.eventId)
+                return a.eventId < b.eventId;
+            return a.transactId < b.transactId;
         }
     };
 
@@ -163,6 +310,13 @@ namespace smpl
         Device(const std::string &name, Engine *engine)
                 : name(name), engine(engine), currentTransactId(0), lastTimeUsed(0),
                 transactCount(0), timeUsedSum(0) {}
+        /**
+         * Копия устройства, принадлежащая другому Engine
+         */
+        Device(const Device &other, Engine *engine)
+                : engine(engine), name(other.name), currentTransactId(other.currentTransactId),
+                lastTimeUsed(other.lastTimeUsed), transactCount(other.transactCount),
+                timeUsedSum(other.timeUsedSum) {}
         /**
          * Резервирование устройства за транзактом
          * @param transactId AJ
@@ -204,7 +358,11 @@ namespace smpl
          * @return
          */
         friend bool operator<(const QueueItem &a, const QueueItem &b) {
-            return a.time < b.time || (a.time == b.time && a.priority < b.priority);
+            if (a.time != b.time)
+                return a.time < b.time;
+            if (a.priority != b.priority)
+                return a.priority < b.priority;
+            return a.transactId < b.transactId;
         }
     };
 
@@ -237,6 +395,16 @@ namespace smpl
                 waitTimeSum(0), waitTimeSumSquared(0), lastTimeChanged(0), count(0) {
             assert(engine != NULL);
         }
+        /**
+         * Копия очереди, принадлежащая другому Engine
+         */
+        Queue(const Queue &other, Engine *engine)
+                : engine(engine), maxLength(other.maxLength), timeQueueSum(other.timeQueueSum),
+                waitTimeSum(other.waitTimeSum), waitTimeSumSquared(other.waitTimeSumSquared),
+                lastTimeChanged(other.lastTimeChanged), count(other.count), queue(other.queue),
+                name(other.name) {
+            assert(engine != NULL);
+        }
         /**
          * Помещение транзакта в очередь
          * @param transactId AJ, транзакт
@@ -250,6 +418,11 @@ namespace smpl
          * @return
          */
         transact_t head(u64 &stage);
+        /**
+         * Удаление из очереди конкретного элемента
+         * @param item Элемент, помещенный в очередь через enqueue()
+         */
+        void remove(const QueueItem &item);
         size_t length();
     };
 
@@ -347,14 +520,43 @@ namespace smpl
         for (int i = 0; i < (int)queues.size(); ++i) {
             delete queues[i];
         }
-        queues.empty();
+        queues.clear();
 
         for (int i = 0; i < (int)devices.size(); ++i) {
             delete devices[i];
         }
-        devices.empty();
+        devices.clear();
+
+        for (int i = 0; i < (int)sources.size(); ++i) {
+            delete sources[i];
+        }
+        sources.clear();
+
+        events.clear();
+    }
+
+    Engine *Engine::clone() const {
+        Engine * e = new Engine(outs, rng);
+        e->events = events;
+        e->transactCounter = transactCounter;
+        e->_time = _time;
+        for (size_t i = 0; i < queues.size(); ++i) {
+            e->queues.push_back(new Queue(*queues[i], e));
+        }
+        for (size_t i = 0; i < devices.size(); ++i) {
+            e->devices.push_back(new Device(*devices[i], e));
+        }
+        for (size_t i = 0; i < sources.size(); ++i) {
+            e->sources.push_back(new ArrivalSource(*sources[i]));
+        }
+        return e;
+    }
 
-        events.empty();
+    void Engine::seed(u64 seed) {
+        rng.seed(seed);
+        for (size_t i = 0; i < sources.size(); ++i) {
+            sources[i]->seed(rng.next());
+        }
     }
 
     Device *Engine::createDevice(std::string name) {
@@ -369,6 +571,35 @@ namespace smpl
         return q;
     }
 
+    ArrivalSource *Engine::createSource(u64 eventId, ArrivalSource::Distribution distribution, uint a, uint b) {
+        ArrivalSource * s = new ArrivalSource(eventId, distribution, a, b, rng.next());
+        s->nextTime = _time + s->interval();
+        sources.push_back(s);
+        return s;
+    }
+
+    transact_t Engine::newTransact() {
+        return transactCounter++;
+    }
+
+    Device *Engine::getDevice(size_t i) {
+        assert(i < devices.size());
+        return devices[i];
+    }
+
+    size_t Engine::devicesCount() {
+        return devices.size();
+    }
+
+    Queue *Engine::getQueue(size_t i) {
+        assert(i < queues.size());
+        return queues[i];
+    }
+
+    size_t Engine::queuesCount() {
+        return queues.size();
+    }
+
     void Engine::schedule(u64 eventId, time_t time, transact_t transactId) {
         assert(time >= 0);
         Event e;
@@ -379,7 +610,25 @@ namespace smpl
     }
 
     std::pair<u64, transact_t> Engine::cause() {
-        assert(events.size() > 0);
+        assert(hasEvents());
+
+        // Ближайшее поступление от источников заявок
+        ArrivalSource * source = NULL;
+        for (size_t i = 0; i < sources.size(); ++i) {
+            ArrivalSource * s = sources[i];
+            if (s->active() && (source == NULL || s->nextTime < source->nextTime
+                                || (s->nextTime == source->nextTime && s->eventId < source->eventId))) {
+                source = s;
+            }
+        }
+        if (source != NULL && (events.empty() || source->nextTime < events.begin()->time
+                               || (source->nextTime == events.begin()->time
+                                   && source->eventId < events.begin()->eventId))) {
+            _time = source->nextTime;
+            source->count++;
+            source->nextTime = _time + source->interval();
+            return std::make_pair(source->eventId, newTransact());
+        }
 
         Event e = *events.begin();
         events.erase(events.begin());
@@ -408,20 +657,50 @@ namespace smpl
         return _time;
     }
 
+    bool Engine::hasEvents() {
+        if (!events.empty())
+            return true;
+        for (size_t i = 0; i < sources.size(); ++i) {
+            if (sources[i]->active())
+                return true;
+        }
+        return false;
+    }
+
+    bool Engine::earlier(const std::pair<Event, bool> &a, const std::pair<Event, bool> &b) {
+        return a.first.time < b.first.time
+               || (a.first.time == b.first.time && a.first.eventId < b.first.eventId);
+    }
+
     void Engine::printEventsState() {
         std::vector< std::vector<std::string> > table(1);
         table[0].push_back("Время события");
         table[0].push_back("Номер события");
         table[0].push_back("Номер транзакта");
-        table.resize(events.size() + 1);
-
-        int i = 1;
+        // Очередные поступления от источников заявок показываются вместе со списком,
+        // признак second отмечает поступление, у которого еще нет номера транзакта
+        std::vector< std::pair<Event, bool> > rows;
         for (std::set<Event>::iterator it = events.begin(); it != events.end(); it++) {
-            Event e = *it;
-            table[i].push_back(toString(e.time));
-            table[i].push_back(toString(e.eventId));
-            table[i].push_back(toString(e.transactId));
-            i++;
+            rows.push_back(std::make_pair(*it, false));
+        }
+        for (size_t j = 0; j < sources.size(); ++j) {
+            if (!sources[j]->active())
+                continue;
+            Event e;
+            e.time = sources[j]->nextTime;
+            e.eventId = sources[j]->eventId;
+            e.transactId = 0;
+            rows.push_back(std::make_pair(e, true));
+        }
+        // При равенстве времени и номера события cause() выбирает событие из списка
+        std::stable_sort(rows.begin(), rows.end(), earlier);
+        table.resize(rows.size() + 1);
+
+        for (size_t i = 0; i < rows.size(); ++i) {
+            const Event &e = rows[i].first;
+            table[i+1].push_back(toString(e.time));
+            table[i+1].push_back(toString(e.eventId));
+            table[i+1].push_back(rows[i].second ? "-" : toString(e.transactId));
         }
 
         *outs << "Список событий:\n";
@@ -538,11 +817,11 @@ namespace smpl
         if (L > R) {
             std::swap(L, R);
         }
-        return L + rand()%(R-L);
+        return L + rng.next()%(R-L);
     }
 
     double Engine::fRandom() {
-        return rand() * 1.0 / RAND_MAX;
+        return rng.uniform();
     }
 
     uint Engine::negExp(uint x) {
@@ -553,6 +832,26 @@ namespace smpl
         return (uint) round(x * -log(1.0 - fRandom()));
     }
 
+    void ArrivalSource::seed(u64 seed) {
+        rng.seed(seed);
+    }
+
+    time_t ArrivalSource::interval() {
+        switch (distribution) {
+            case Uniform:
+                return a + rng.next() % (b - a);
+            case Exponential:
+                return (time_t) round(a * -log(1.0 - rng.uniform()));
+            case Constant:
+            default:
+                return a;
+        }
+    }
+
+    bool ArrivalSource::active() {
+        return limit == 0 || count < limit;
+    }
+
     void Device::reserve(transact_t transactId) {
         assert(currentTransactId == 0);
         currentTransactId = transactId;
@@ -581,16 +880,20 @@ namespace smpl
 
     transact_t Queue::head(u64 &stage) {
         QueueItem qi = *queue.begin();
-        queue.erase(queue.begin());
+        remove(qi);
+        stage = qi.stage;
+        return qi.transactId;
+    }
+
+    void Queue::remove(const QueueItem &qi) {
+        size_t erased = queue.erase(qi);
+        assert(erased == 1);
 
         timeQueueSum += (queue.size() + 1) * (engine->getTime() - lastTimeChanged);
         waitTimeSum += engine->getTime() - qi.time;
         waitTimeSumSquared += (engine->getTime() - qi.time) * (engine->getTime() - qi.time);
         lastTimeChanged = engine->getTime();
         count++;
-
-        stage = qi.stage;
-        return qi.transactId;
     }
 
     size_t Queue::length() {
@@ -0,0 +1,196 @@
+#ifndef SMPL_SPLITTING_H
+#define SMPL_SPLITTING_H
+
+#include <vector>
+#include <utility>
+
+#include <cmath>
+
+#include "smpl.h"
+
+namespace smpl
+{
+    /**
+     * Траектория моделирования для оценки вероятности редкого события расщеплением.
+     * Владеет своим Engine; наследник хранит состояние модели (счетчики, указатели
+     * на устройства и очереди) и умеет переносить его на копию Engine.
+     */
+    class Trajectory {
+    protected:
+        Engine *engine;
+
+    private:
+        Trajectory(const Trajectory &);
+        Trajectory &operator=(const Trajectory &);
+
+    public:
+        Trajectory(Engine *engine) : engine(engine) {
+            assert(engine != NULL);
+        }
+        virtual ~Trajectory() {
+            delete engine;
+        }
+        Engine * getEngine() const {
+            return engine;
+        }
+        /**
+         * Копия траектории поверх копии Engine.
+         * Устройства и очереди копии берутся из engine->getDevice() и engine->getQueue()
+         * @param engine Результат getEngine()->clone()
+         * @return Новая траектория, владеющая engine
+         */
+        virtual Trajectory * clone(Engine *engine) const = 0;
+        /**
+         * Обработка очередного события
+         * @return false, если траектория завершена (например, истекло время моделирования)
+         */
+        virtual bool step() = 0;
+        /**
+         * Функция важности: чем больше значение, тем ближе модель к редкому событию.
+         * Например, Queue::maxLength
+         */
+        virtual double importance() = 0;
+    };
+
+    /**
+     * Результат оценки вероятности расщеплением
+     */
+    class SplittingResult {
+    public:
+        /** Оценка вероятности достижения последнего уровня */
+        double probability;
+        /** Относительная ошибка оценки (отношение ср.кв.откл. оценки к ней самой) */
+        double relativeError;
+        /** Число траекторий, достигших последнего уровня */
+        u64 hits;
+        /** Число смоделированных траекторий: исходные траектории и их копии */
+        u64 trajectories;
+        /** Число обработанных событий */
+        u64 events;
+        /** Число пересечений каждого уровня */
+        std::vector<u64> crossings;
+
+        SplittingResult()
+                : probability(0), relativeError(0), hits(0), trajectories(0), events(0) {}
+    };
+
+    /**
+     * Многоуровневое расщепление с фиксированными коэффициентами.
+     *
+     * Каждая траектория моделируется до пересечения следующего уровня функции важности
+     * или до завершения. При пересечении уровня k траектория заменяется factor[k]
+     * независимыми копиями (Engine::clone() с новым зерном генератора), каждая из которых
+     * получает вес 1/factor[k]. Вероятность достижения последнего уровня оценивается
+     * как средний суммарный вес достигших его траекторий на одну исходную траекторию.
+     */
+    class Splitting {
+    private:
+        std::vector<double> levels;
+        std::vector<uint> factors;
+        Random rng;
+
+        double run(Trajectory *root, SplittingResult &result);
+
+    public:
+        Splitting(u64 seed) : rng(seed) {}
+        /**
+         * Добавление уровня функции важности
+         * Уровни добавляются по возрастанию, последний уровень задает редкое событие
+         * @param level Значение функции важности
+         * @param factor Число копий траектории, пересекшей уровень
+         */
+        void addLevel(double level, uint factor);
+        /**
+         * Оценка вероятности достижения последнего уровня
+         * @param prototype Начальное состояние модели, не изменяется
+         * @param replications Число исходных траекторий
+         */
+        SplittingResult estimate(const Trajectory &prototype, u64 replications);
+    };
+
+    void Splitting::addLevel(double level, uint factor) {
+        assert(levels.empty() || levels.back() < level);
+        assert(factor > 0);
+        levels.push_back(level);
+        factors.push_back(factor);
+    }
+
+    SplittingResult Splitting::estimate(const Trajectory &prototype, u64 replications) {
+        assert(!levels.empty());
+        assert(replications > 0);
+
+        SplittingResult result;
+        result.crossings.assign(levels.size(), 0);
+
+        double sum = 0, sumSquared = 0;
+        for (u64 i = 0; i < replications; ++i) {
+            Trajectory *root = prototype.clone(prototype.getEngine()->clone());
+            root->getEngine()->seed(rng.next());
+            double w = run(root, result);
+            sum += w;
+            sumSquared += w * w;
+        }
+
+        double n = (double) replications;
+        result.probability = sum / n;
+        if (result.probability > 0 && replications > 1) {
+            double variance = (sumSquared - sum * sum / n) / (n - 1);
+            result.relativeError = sqrt(std::max(variance, 0.0) / n) / result.probability;
+        }
+        return result;
+    }
+
+    /**
+     * Моделирование исходной траектории и всех ее копий в глубину
+     * @return Суммарный вес копий, достигших последнего уровня
+     */
+    double Splitting::run(Trajectory *root, SplittingResult &result) {
+        double hitWeight = 0;
+        // Траектория, номер следующего уровня и вес
+        std::vector< std::pair<Trajectory *, std::pair<size_t, double> > > stack;
+        stack.push_back(std::make_pair(root, std::make_pair((size_t) 0, 1.0)));
+        result.trajectories++;
+
+        while (!stack.empty()) {
+            Trajectory *t = stack.back().first;
+            size_t level = stack.back().second.first;
+            double weight = stack.back().second.second;
+            stack.pop_back();
+
+            bool alive = true;
+            while (alive && t->importance() < levels[level]) {
+                alive = t->step();
+                result.events++;
+            }
+
+            if (t->importance() >= levels[level]) {
+                // Скачок функции важности может пересечь сразу несколько уровней
+                uint copies = 1;
+                while (level < levels.size() && t->importance() >= levels[level]) {
+                    result.crossings[level]++;
+                    copies *= factors[level];
+                    level++;
+                }
+                if (level == levels.size()) {
+                    result.hits++;
+                    hitWeight += weight;
+                } else {
+                    weight /= copies;
+                    for (uint i = 1; i < copies; ++i) {
+                        Trajectory *copy = t->clone(t->getEngine()->clone());
+                        copy->getEngine()->seed(rng.next());
+                        stack.push_back(std::make_pair(copy, std::make_pair(level, weight)));
+                        result.trajectories++;
+                    }
+                    t->getEngine()->seed(rng.next());
+                    stack.push_back(std::make_pair(t, std::make_pair(level, weight)));
+                    continue;
+                }
+            }
+            delete t;
+        }
+        return hitWeight;
+    }
+}
+
+#endif //SMPL_SPLITTING_H